@@ -0,0 +1,352 @@
+// Authors: Matthew Johnson and Nathan Ly
+// GameJam
+// F9 capture: every rendered frame is read back into one of CAPTURE_SLOTS pixel buffer objects
+// and a worker thread converts it to YUV 4:2:0 and writes a .y4m next to the game.
+// glReadPixels into a PBO only queues the copy; the buffer is mapped a frame or more later, once
+// its fence has signalled, so the main loop never stalls on the GPU or on the worker. If every
+// slot is still busy the frame is dropped (and counted). Play it with: ffplay capture_000.y4m
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "raylib.h"
+#include "rlgl.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#ifndef HEADLESS
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+#define CAPTURE_SLOTS       8
+#define CAPTURE_STOP_WAIT   1000000000  // ns CaptureStop waits on a readback before giving it up
+
+// a slot goes around FREE -> READING (GPU copy in flight) -> QUEUED (mapped, worker owns it)
+// -> WRITTEN -> FREE. the headless backend has the pixels in memory and skips READING
+enum { SLOT_FREE, SLOT_READING, SLOT_QUEUED, SLOT_WRITTEN };
+
+typedef struct {
+    bool running;
+    int w, h, stride, rows;
+    bool flipped;
+    FILE *out;
+    char path[64];
+
+    // single producer (main) / single consumer (worker) ring over the slots
+    unsigned char *rgba[CAPTURE_SLOTS];
+    atomic_int state[CAPTURE_SLOTS];
+    int head, ready, tail;
+#ifndef HEADLESS
+    GLuint pbo[CAPTURE_SLOTS];
+    GLsync fence[CAPTURE_SLOTS];
+#endif
+
+    unsigned char *yuv;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    bool stopping;
+
+    int captured, dropped;
+    atomic_int written;
+} Capture;
+
+static Capture capture;
+
+// BT.601 full range, 8.8 fixed point. the SIMD and scalar paths do the same integer math
+static inline unsigned char CaptureClamp(int v) { return v < 0 ? 0 : v > 255 ? 255 : v; }
+
+static void CaptureLumaRow(const unsigned char *rgba, unsigned char *y, int width)
+{
+    int x = 0;
+#if defined(__SSE2__)
+    __m128i lowByte = _mm_set1_epi32(0xFF);
+    __m128i kr = _mm_set1_epi16(77), kg = _mm_set1_epi16(150), kb = _mm_set1_epi16(29), half = _mm_set1_epi16(128);
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i p0 = _mm_loadu_si128((const __m128i *)(rgba + x * 4));
+        __m128i p1 = _mm_loadu_si128((const __m128i *)(rgba + x * 4 + 16));
+        __m128i r = _mm_packs_epi32(_mm_and_si128(p0, lowByte), _mm_and_si128(p1, lowByte));
+        __m128i g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), lowByte), _mm_and_si128(_mm_srli_epi32(p1, 8), lowByte));
+        __m128i b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), lowByte), _mm_and_si128(_mm_srli_epi32(p1, 16), lowByte));
+        __m128i l = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, kr), _mm_mullo_epi16(g, kg)), _mm_add_epi16(_mm_mullo_epi16(b, kb), half));
+        l = _mm_srli_epi16(l, 8);
+        _mm_storel_epi64((__m128i *)(y + x), _mm_packus_epi16(l, l));
+    }
+#endif
+    for (; x < width; x++)
+    {
+        const unsigned char *p = rgba + (size_t)x * 4;
+        y[x] = (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+    }
+}
+
+// one row of chroma from two rows of pixels, each sample is the average of a 2x2 block
+static void CaptureChromaRow(const unsigned char *row0, const unsigned char *row1, unsigned char *u, unsigned char *v, int width)
+{
+    int x = 0;
+#if defined(__SSE2__)
+    __m128i lowByte = _mm_set1_epi32(0xFF), ones = _mm_set1_epi16(1), two = _mm_set1_epi32(2);
+    __m128i ur = _mm_set1_epi16(-43), ug = _mm_set1_epi16(-85), ub = _mm_set1_epi16(128);
+    __m128i vr = _mm_set1_epi16(128), vg = _mm_set1_epi16(-107), vb = _mm_set1_epi16(-21);
+    __m128i half = _mm_set1_epi16(128);
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i sum[3];
+        for (int c = 0; c < 3; c++)
+        {
+            __m128i acc[2];
+            for (int k = 0; k < 2; k++)
+            {
+                const unsigned char *a = row0 + (x + k * 8) * 4, *b = row1 + (x + k * 8) * 4;
+                __m128i a0 = _mm_and_si128(_mm_srli_epi32(_mm_loadu_si128((const __m128i *)a), c * 8), lowByte);
+                __m128i a1 = _mm_and_si128(_mm_srli_epi32(_mm_loadu_si128((const __m128i *)(a + 16)), c * 8), lowByte);
+                __m128i b0 = _mm_and_si128(_mm_srli_epi32(_mm_loadu_si128((const __m128i *)b), c * 8), lowByte);
+                __m128i b1 = _mm_and_si128(_mm_srli_epi32(_mm_loadu_si128((const __m128i *)(b + 16)), c * 8), lowByte);
+                // vertical add in 16 bit lanes, then madd sums horizontal neighbours into 32 bit
+                __m128i vert = _mm_add_epi16(_mm_packs_epi32(a0, a1), _mm_packs_epi32(b0, b1));
+                acc[k] = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(vert, ones), two), 2);
+            }
+            sum[c] = _mm_packs_epi32(acc[0], acc[1]);
+        }
+        __m128i uu = _mm_add_epi16(_mm_mullo_epi16(sum[0], ur), _mm_add_epi16(_mm_mullo_epi16(sum[1], ug), _mm_mullo_epi16(sum[2], ub)));
+        __m128i vv = _mm_add_epi16(_mm_mullo_epi16(sum[0], vr), _mm_add_epi16(_mm_mullo_epi16(sum[1], vg), _mm_mullo_epi16(sum[2], vb)));
+        uu = _mm_add_epi16(_mm_srai_epi16(_mm_adds_epi16(uu, half), 8), half);
+        vv = _mm_add_epi16(_mm_srai_epi16(_mm_adds_epi16(vv, half), 8), half);
+        _mm_storel_epi64((__m128i *)(u + x / 2), _mm_packus_epi16(uu, uu));
+        _mm_storel_epi64((__m128i *)(v + x / 2), _mm_packus_epi16(vv, vv));
+    }
+#endif
+    for (; x + 2 <= width; x += 2)
+    {
+        int rgb[3];
+        for (int c = 0; c < 3; c++)
+            rgb[c] = (row0[x*4 + c] + row0[x*4 + 4 + c] + row1[x*4 + c] + row1[x*4 + 4 + c] + 2) >> 2;
+        int tu = -43 * rgb[0] - 85 * rgb[1] + 128 * rgb[2] + 128;
+        int tv = 128 * rgb[0] - 107 * rgb[1] - 21 * rgb[2] + 128;
+        // match the saturating 16 bit add of the SIMD path
+        if (tu > 32767) tu = 32767;
+        if (tv > 32767) tv = 32767;
+        u[x / 2] = CaptureClamp((tu >> 8) + 128);
+        v[x / 2] = CaptureClamp((tv >> 8) + 128);
+    }
+}
+
+// GL hands rows back bottom-up, so the worker flips them while it converts
+static inline const unsigned char *CaptureRow(const unsigned char *rgba, int row)
+{
+    if (capture.flipped) row = capture.rows - 1 - row;
+    return rgba + (size_t)row * capture.stride;
+}
+
+static void CaptureWriteFrame(const unsigned char *rgba)
+{
+    int cw = capture.w / 2, ch = capture.h / 2;
+    unsigned char *y = capture.yuv, *u = y + capture.w * capture.h, *v = u + cw * ch;
+
+    for (int row = 0; row < capture.h; row++)
+        CaptureLumaRow(CaptureRow(rgba, row), y + row * capture.w, capture.w);
+    for (int row = 0; row < ch; row++)
+        CaptureChromaRow(CaptureRow(rgba, row * 2), CaptureRow(rgba, row * 2 + 1), u + row * cw, v + row * cw, capture.w);
+
+    fputs("FRAME\n", capture.out);
+    fwrite(capture.yuv, 1, (size_t)capture.w * capture.h + 2 * cw * ch, capture.out);
+    atomic_fetch_add(&capture.written, 1);
+}
+
+static void *CaptureWorker(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        int slot = capture.tail;
+        pthread_mutex_lock(&capture.lock);
+        while (atomic_load(&capture.state[slot]) != SLOT_QUEUED && !capture.stopping)
+            pthread_cond_wait(&capture.wake, &capture.lock);
+        bool idle = atomic_load(&capture.state[slot]) != SLOT_QUEUED;
+        pthread_mutex_unlock(&capture.lock);
+        if (idle) return NULL;  // stopping and everything queued has been written
+
+        // a readback that never came back is queued empty to keep the ring in order
+        if (capture.rgba[slot]) CaptureWriteFrame(capture.rgba[slot]);
+        atomic_store(&capture.state[slot], SLOT_WRITTEN);
+        capture.tail = (slot + 1) % CAPTURE_SLOTS;
+    }
+}
+
+static void CaptureQueue(int slot)
+{
+    pthread_mutex_lock(&capture.lock);
+    atomic_store(&capture.state[slot], SLOT_QUEUED);
+    pthread_cond_signal(&capture.wake);
+    pthread_mutex_unlock(&capture.lock);
+}
+
+// main thread only: takes back slots the worker is done with, and hands finished readbacks to
+// the worker in ring order. only CaptureStop asks it to block on the GPU
+static void CapturePoll(bool block)
+{
+    for (int i = 0; i < CAPTURE_SLOTS; i++)
+    {
+        if (atomic_load(&capture.state[i]) != SLOT_WRITTEN) continue;
+#ifndef HEADLESS
+        if (capture.rgba[i])
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.pbo[i]);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            capture.rgba[i] = NULL;
+        }
+#endif
+        atomic_store(&capture.state[i], SLOT_FREE);
+    }
+
+#ifndef HEADLESS
+    while (atomic_load(&capture.state[capture.ready]) == SLOT_READING)
+    {
+        int slot = capture.ready;
+        GLenum sync = glClientWaitSync(capture.fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, block ? CAPTURE_STOP_WAIT : 0);
+        bool done = sync == GL_ALREADY_SIGNALED || sync == GL_CONDITION_SATISFIED;
+        if (!done && !block) break;
+
+        glDeleteSync(capture.fence[slot]);
+        capture.fence[slot] = NULL;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.pbo[slot]);
+        capture.rgba[slot] = done ? glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)capture.stride * capture.rows, GL_MAP_READ_BIT) : NULL;
+        CaptureQueue(slot);
+        capture.ready = (slot + 1) % CAPTURE_SLOTS;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+#else
+    (void)block;
+#endif
+}
+
+static void CaptureFreeSlots(void)
+{
+#ifdef HEADLESS
+    for (int i = 0; i < CAPTURE_SLOTS; i++) free(capture.rgba[i]);
+#else
+    for (int i = 0; i < CAPTURE_SLOTS; i++)
+    {
+        if (capture.rgba[i])
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.pbo[i]);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        if (capture.fence[i]) glDeleteSync(capture.fence[i]);
+        capture.rgba[i] = NULL;
+        capture.fence[i] = NULL;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glDeleteBuffers(CAPTURE_SLOTS, capture.pbo);
+#endif
+    free(capture.yuv);
+}
+
+static void CaptureStart(int width, int height, int fps)
+{
+    if (capture.running) return;
+    for (int n = 0; n < 1000; n++)
+    {
+        snprintf(capture.path, sizeof(capture.path), "capture_%03d.y4m", n);
+        if (!FileExists(capture.path)) break;
+    }
+    capture.out = fopen(capture.path, "wb");
+    if (!capture.out) { TraceLog(LOG_WARNING, "CAPTURE: can't open %s", capture.path); return; }
+    setvbuf(capture.out, NULL, _IOFBF, 1 << 20);
+
+    // y4m 4:2:0 wants even sizes, an odd last row/column just gets cropped
+    capture.stride = width * 4;
+    capture.rows = height;
+    capture.w = width & ~1;
+    capture.h = height & ~1;
+    // the samples are full range, untagged 420jpeg gets read as limited (crushed blacks, loud chroma)
+    fprintf(capture.out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", capture.w, capture.h, fps);
+
+#ifdef HEADLESS
+    capture.flipped = false;
+    for (int i = 0; i < CAPTURE_SLOTS; i++) capture.rgba[i] = malloc((size_t)capture.stride * height);
+#else
+    capture.flipped = true;
+    glGenBuffers(CAPTURE_SLOTS, capture.pbo);
+    for (int i = 0; i < CAPTURE_SLOTS; i++)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.pbo[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)capture.stride * height, NULL, GL_STREAM_READ);
+        capture.rgba[i] = NULL;
+        capture.fence[i] = NULL;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+#endif
+    for (int i = 0; i < CAPTURE_SLOTS; i++) atomic_store(&capture.state[i], SLOT_FREE);
+    capture.yuv = malloc((size_t)capture.w * capture.h * 3 / 2);
+    capture.head = capture.ready = capture.tail = 0;
+    capture.captured = capture.dropped = 0;
+    atomic_store(&capture.written, 0);
+    capture.stopping = false;
+
+    pthread_mutex_init(&capture.lock, NULL);
+    pthread_cond_init(&capture.wake, NULL);
+    if (pthread_create(&capture.thread, NULL, CaptureWorker, NULL) != 0)
+    {
+        TraceLog(LOG_WARNING, "CAPTURE: can't start writer thread");
+        fclose(capture.out);
+        CaptureFreeSlots();
+        return;
+    }
+    capture.running = true;
+    TraceLog(LOG_INFO, "CAPTURE: recording to %s", capture.path);
+}
+
+// call between drawing the frame and EndDrawing, while the back buffer still holds it
+static void CaptureFrame(void)
+{
+    if (!capture.running) return;
+    CapturePoll(false);
+    int slot = capture.head;
+    if (atomic_load(&capture.state[slot]) != SLOT_FREE) { capture.dropped++; return; }
+
+    capture.captured++;
+    capture.head = (slot + 1) % CAPTURE_SLOTS;
+    rlDrawRenderBatchActive();
+#ifdef HEADLESS
+    memcpy(capture.rgba[slot], sr.pixels, (size_t)capture.stride * sr.h);
+    CaptureQueue(slot);
+#else
+    // with a pack buffer bound glReadPixels returns right away and the copy runs on the GPU
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.pbo[slot]);
+    glReadPixels(0, 0, capture.stride / 4, capture.rows, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    capture.fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    atomic_store(&capture.state[slot], SLOT_READING);
+#endif
+}
+
+// flushes whatever is still queued, so this one is allowed to block
+static void CaptureStop(void)
+{
+    if (!capture.running) return;
+    CapturePoll(true);
+    pthread_mutex_lock(&capture.lock);
+    capture.stopping = true;
+    pthread_cond_signal(&capture.wake);
+    pthread_mutex_unlock(&capture.lock);
+    pthread_join(capture.thread, NULL);
+
+    fclose(capture.out);
+    CaptureFreeSlots();
+    pthread_mutex_destroy(&capture.lock);
+    pthread_cond_destroy(&capture.wake);
+    capture.running = false;
+    TraceLog(LOG_INFO, "CAPTURE: %s done, %d frames written, %d dropped", capture.path, atomic_load(&capture.written), capture.dropped);
+}
+
+#endif
\ No newline at end of file
@@ -1,17 +1,58 @@
 // Authors: Matthew Johnson and Nathan Ly 
 // GameJam
 // gcc -o oneshotv1 oneshotv1.c -lraylib -lGL -lm -lpthread -ldl -lrt -lX11 && ./oneshotv1
+// headless (software renderer, see softraster.h): gcc -DHEADLESS -O2 -o oneshot_headless oneshotv1.c -lraylib -lm -lpthread -ldl -lrt
 
 #include "raylib.h"
+#include "rlgl.h"
 #include <math.h>
 #include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifdef HEADLESS
+#include "softraster.h"
+#endif
+#include "capture.h"
 
 #define MAX_ENEMIES     100
 #define MAX_BULLETS     600
 #define MAX_EXPLOSIONS  40
 
+// FLOCKING - enemies are bucketed into a uniform grid every tick so each one
+// only looks at the 3x3 cells around it instead of every other enemy. crowded
+// cells are sampled, up to FLOCK_OWN_SAMPLES from its own and FLOCK_NEAR_SAMPLES
+// from each neighbor, so a packed wave costs at most 48 checks per enemy
+#define GRID_CELL           128
+#define GRID_MAX_CELLS      1024
+#define FLOCK_OWN_SAMPLES   16
+#define FLOCK_NEAR_SAMPLES  4
+#define FLOCK_RADIUS        110.0f
+#define FLOCK_SEPARATION    20.0f
+#define FLOCK_ALIGNMENT     0.6f
+#define FLOCK_COHESION      0.2f
+
+// AI SCHEDULE - rerolls, shots, burst steps and shake ends sit in a wheel of
+// WHEEL_SLOTS buckets of WHEEL_TICK seconds, so a tick only touches what is due.
+// 256 x 1/64s = 4s per lap; anything further out just waits for its lap to come round
+#define WHEEL_SLOTS         256
+#define WHEEL_TICK          (1.0f/64.0f)
+
+// FX GOVERNOR - sim + render time is measured every frame and smoothed; staying
+// over FX_STEP_DOWN of the budget drops a quality tier, staying under FX_STEP_UP
+// for a good while earns it back. Only cosmetics change, never gameplay
+#define FRAME_BUDGET        (1.0f/60.0f)
+#define FX_STEP_DOWN        0.9f
+#define FX_STEP_UP          0.5f
+#define FX_DOWN_FRAMES      15
+#define FX_UP_FRAMES        120
+#define FX_LOW_RATE_STEP    (1.0f/30.0f)
+
 typedef enum { MENU, LEVELS, PLAY, SHOP, SUCCESS, FAIL, WIN, CREDITS } Screen;
 typedef enum { BASIC, GRENADE, LASER, SHIELD } Weapon;
+typedef enum { EV_REROLL, EV_SHOT, EV_BURST, EV_SHAKE_END, EV_COUNT } EnemyEvent;
+typedef enum { FX_FULL, FX_NO_LABELS, FX_THIN_PARTICLES, FX_NO_SHAKE, FX_LOW_RATE, FX_TIERS } FxTier;
 
 typedef struct {
     Vector2 pos;
@@ -35,11 +76,9 @@ typedef struct {
     float size;
     float baseSize;
     Color color;
-    float shootTimer;
-    float changeTimer;
     int burstCount;
     bool bigRocket;
-    float shakeTimer;
+    bool shaking;
     Vector2 shakeOffset;
 } Enemy;
 
@@ -49,12 +88,46 @@ typedef struct {
     bool active;
 } Explosion;
 
+// one per (enemy, event) pair, linked into the bucket of its due tick
+typedef struct {
+    int next, prev;
+    int slot;
+    unsigned int due;
+} WheelNode;
+
+// copy of the bits flocking needs in grid order, one array per field so a neighbor scan
+// can load four candidates at once. the +3 lets a 4 wide load run past the last enemy
+typedef struct {
+    float x[MAX_ENEMIES + 3], y[MAX_ENEMIES + 3];
+    float vx[MAX_ENEMIES + 3], vy[MAX_ENEMIES + 3];
+    float size[MAX_ENEMIES + 3];
+    int kind[MAX_ENEMIES + 3], id[MAX_ENEMIES + 3];
+} FlockGrid;
+
+// one enemy's running sums, split into 4 lanes. candidate n of a span always lands in
+// lane n % 4 and the lanes are folded in a fixed order, so SSE2 and scalar builds agree bit for bit
+typedef struct {
+    float sepX[4], sepY[4];
+    float velX[4], velY[4];
+    float posX[4], posY[4];
+    int mates[4];
+} FlockSums;
+
 typedef struct {
     bool active;
     float duration;
     float alpha;
 } Shield;
 
+typedef struct {
+    FxTier tier;
+    bool locked;
+    float cost;
+    float headroom;
+    int overFrames, underFrames;
+    float cosmeticTime;
+} Governor;
+
 typedef struct {
     int gold;
     int ammo;
@@ -81,6 +154,20 @@ SavedState saved;
 float spinAngle = 0, countdown = 0, screenTimer = 0;
 float playerShakeTimer = 0;
 Vector2 playerShakeOffset = {0,0};
+int gridCols, gridRows;
+int gridStart[GRID_MAX_CELLS + 1];
+int gridFill[GRID_MAX_CELLS];
+FlockGrid flock;
+int enemyCell[MAX_ENEMIES];
+Vector2 flockSteer[MAX_ENEMIES];
+unsigned int flockTick;
+WheelNode wheelNodes[MAX_ENEMIES * EV_COUNT];
+int wheelHead[WHEEL_SLOTS];
+unsigned int wheelNow;
+float wheelClock;
+int shakeList[MAX_ENEMIES], shakeIndex[MAX_ENEMIES], shakeCount;
+Governor gov;
+unsigned int fxSeed = 0x2545F491u;
 
 void InitGame(void);
 void UpdateGame(float dt);
@@ -88,11 +175,20 @@ void DrawGame(void);
 void SpawnLevel(int lvl);
 void FireWeapon(void);
 void UpdateEnemies(float dt);
+void BuildEnemyGrid(void);
+void UpdateFlocking(void);
+void ResetEnemySchedule(void);
+void ScheduleEnemy(int e, EnemyEvent ev, float delay);
+void RunEnemySchedule(float dt);
+void StartEnemyShake(int e, float duration);
 void UpdateBullets(float dt);
 void HandleCollisions(float dt);
 void DrawPlayer(void);
 void DrawShield(void);
 void DrawHUD(void);
+void InitGovernor(void);
+void UpdateGovernor(double simTime, double renderTime);
+void UpdateCosmetics(float dt);
 void DrawShop(void);
 void DrawControlsOverlay(void);
 
@@ -101,11 +197,13 @@ int main(void)
     InitWindow(1200, 800, "ONE SHOT, ONE KILL");
     SetTargetFPS(60);
     InitGame();
+    InitGovernor();
 
     while (!WindowShouldClose())
     {
+        double frameStart = GetTime();
         float dt = GetFrameTime();
-        spinAngle += 180 * dt;
+        UpdateCosmetics(dt);
 
         if (IsKeyPressed(KEY_ZERO))
         {
@@ -127,6 +225,12 @@ int main(void)
             }
         }
 
+        if (IsKeyPressed(KEY_F9))
+        {
+            if (capture.running) CaptureStop();
+            else CaptureStart(w, h, 60);
+        }
+
         if (IsKeyPressed(KEY_M) && screen != MENU) { screen = MENU; countdown = 0; screenTimer = 0; continue; }
 
         bool up = IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_W);
@@ -175,12 +279,19 @@ int main(void)
             if (screenTimer > 3.0f || IsKeyPressed(KEY_M)) { screen = MENU; screenTimer = 0; }
         }
 
+        double drawStart = GetTime();
         BeginDrawing();
         ClearBackground(DARKGRAY);
         DrawGame();
+        // submit the batch now so the render sample covers the GL calls (or the software raster)
+        // and not just queueing them; EndDrawing past this point is the swap and frame limiter wait
+        rlDrawRenderBatchActive();
+        UpdateGovernor(drawStart - frameStart, GetTime() - drawStart);
+        CaptureFrame();
         EndDrawing();
     }
 
+    CaptureStop();
     CloseWindow();
     return 0;
 }
@@ -202,6 +313,7 @@ void InitGame(void)
     memset(bullets, 0, sizeof(bullets));
     memset(enemies, 0, sizeof(enemies));
     memset(explosions, 0, sizeof(explosions));
+    ResetEnemySchedule();
     shield = (Shield){0};
 }
 
@@ -210,6 +322,7 @@ void SpawnLevel(int lvl)
     alive = bigAlive = 0;
     memset(bullets, 0, sizeof(bullets));
     memset(enemies, 0, sizeof(enemies));
+    ResetEnemySchedule();
 
     int smallCount = (lvl == 1) ? 10 : 20;
     int bigCount = (lvl == 2) ? 3 : (lvl == 3) ? 3 : 0;
@@ -233,13 +346,14 @@ void SpawnLevel(int lvl)
             .size = size,
             .baseSize = size,
             .color = isBoss ? MAROON : ORANGE,
-            .shootTimer = 0,
-            .changeTimer = GetRandomValue(150,300)*0.01f,
             .burstCount = 0,
             .bigRocket = false,
-            .shakeTimer = 0,
+            .shaking = false,
             .shakeOffset = {0,0}
         };
+        ScheduleEnemy(idx-1, EV_REROLL, GetRandomValue(150,300)*0.01f);
+        if (isBoss) ScheduleEnemy(idx-1, EV_BURST, 0.8f);
+        else ScheduleEnemy(idx-1, EV_SHOT, 1.8f);
         alive++; bigAlive++;
     }
 
@@ -258,11 +372,10 @@ void SpawnLevel(int lvl)
             .size = 24,
             .baseSize = 24,
             .color = LIME,
-            .shootTimer = 0,
-            .changeTimer = GetRandomValue(100,300)*0.01f,
-            .shakeTimer = 0,
+            .shaking = false,
             .shakeOffset = {0,0}
         };
+        ScheduleEnemy(idx-1, EV_REROLL, GetRandomValue(100,300)*0.01f);
         alive++;
     }
 }
@@ -351,16 +464,7 @@ void UpdateGame(float dt)
     UpdateEnemies(dt);
     HandleCollisions(dt);
 
-    if (playerShakeTimer > 0)
-    {
-        playerShakeTimer -= dt;
-        playerShakeOffset.x = (GetRandomValue(-100,100)/100.0f) * 4;
-        playerShakeOffset.y = (GetRandomValue(-100,100)/100.0f) * 4;
-    }
-    else
-    {
-        playerShakeOffset = (Vector2){0,0};
-    }
+    if (playerShakeTimer > 0) playerShakeTimer -= dt;
 
     if (level == 1 && alive == 0) { level2 = true; screen = SUCCESS; screenTimer = 0; }
     if (level == 2 && bigAlive == 0) { level3 = true; screen = SUCCESS; screenTimer = 0; }
@@ -434,110 +538,360 @@ void UpdateBullets(float dt)
     }
 }
 
-void UpdateEnemies(float dt)
+int GridCellOf(Vector2 pos)
 {
+    int cx = (int)(pos.x / GRID_CELL), cy = (int)(pos.y / GRID_CELL);
+    if (cx < 0) cx = 0;
+    if (cx >= gridCols) cx = gridCols - 1;
+    if (cy < 0) cy = 0;
+    if (cy >= gridRows) cy = gridRows - 1;
+    return cy * gridCols + cx;
+}
+
+void BuildEnemyGrid(void)
+{
+    gridCols = w / GRID_CELL + 1;
+    gridRows = h / GRID_CELL + 1;
+    if (gridCols * gridRows > GRID_MAX_CELLS) gridRows = GRID_MAX_CELLS / gridCols;
+    int cells = gridCols * gridRows;
+
+    // counting sort: count per cell, prefix sum into start offsets, then scatter
+    memset(gridStart, 0, sizeof(int) * (cells + 1));
     for (int i = 0; i < MAX_ENEMIES; i++)
     {
         if (!enemies[i].alive) continue;
+        enemyCell[i] = GridCellOf(enemies[i].pos);
+        gridStart[enemyCell[i] + 1]++;
+    }
+    for (int c = 0; c < cells; c++)
+    {
+        gridStart[c + 1] += gridStart[c];
+        gridFill[c] = gridStart[c];
+    }
+    for (int i = 0; i < MAX_ENEMIES; i++)
+    {
+        if (!enemies[i].alive) continue;
+        int k = gridFill[enemyCell[i]]++;
+        flock.x[k] = enemies[i].pos.x;
+        flock.y[k] = enemies[i].pos.y;
+        flock.vx[k] = enemies[i].vel.x;
+        flock.vy[k] = enemies[i].vel.y;
+        flock.size[k] = enemies[i].size;
+        flock.kind[k] = enemies[i].boss ? 2 : enemies[i].big ? 1 : 0;
+        flock.id[k] = i;
+    }
+}
 
-        enemies[i].changeTimer -= dt;
-        if (enemies[i].changeTimer <= 0)
+// adds grid entries [from, to) to the sums of the enemy at grid entry self
+static void FlockSpan(int self, int from, int to, FlockSums *sums)
+{
+    float ex = flock.x[self], ey = flock.y[self], esize = flock.size[self];
+    int k = from;
+#if defined(__SSE2__)
+    __m128 sepX = _mm_loadu_ps(sums->sepX), sepY = _mm_loadu_ps(sums->sepY);
+    __m128 velX = _mm_loadu_ps(sums->velX), velY = _mm_loadu_ps(sums->velY);
+    __m128 posX = _mm_loadu_ps(sums->posX), posY = _mm_loadu_ps(sums->posY);
+    __m128i mates = _mm_loadu_si128((const __m128i *)sums->mates);
+    __m128 one = _mm_set1_ps(1.0f), radius2 = _mm_set1_ps(FLOCK_RADIUS * FLOCK_RADIUS);
+    __m128i lane = _mm_setr_epi32(0, 1, 2, 3), end = _mm_set1_epi32(to), me = _mm_set1_epi32(self);
+    __m128i kind = _mm_set1_epi32(flock.kind[self]), id = _mm_set1_epi32(flock.id[self]);
+    for (; k < to; k += 4)
+    {
+        // lanes past the span and the enemy itself are masked out, not branched around
+        __m128i at = _mm_add_epi32(_mm_set1_epi32(k), lane);
+        __m128i live = _mm_andnot_si128(_mm_cmpeq_epi32(at, me), _mm_cmplt_epi32(at, end));
+
+        __m128 dx = _mm_sub_ps(_mm_set1_ps(ex), _mm_loadu_ps(flock.x + k));
+        __m128 dy = _mm_sub_ps(_mm_set1_ps(ey), _mm_loadu_ps(flock.y + k));
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 sepR = _mm_add_ps(_mm_add_ps(_mm_set1_ps(esize), _mm_loadu_ps(flock.size + k)), _mm_set1_ps(8.0f));
+
+        __m128 push = _mm_and_ps(_mm_castsi128_ps(live), _mm_cmplt_ps(d2, _mm_mul_ps(sepR, sepR)));
+        __m128 dist = _mm_sqrt_ps(d2);
+        __m128 same = _mm_cmplt_ps(dist, _mm_set1_ps(0.01f));
+        __m128 side = _mm_castsi128_ps(_mm_cmplt_epi32(id, _mm_loadu_si128((const __m128i *)(flock.id + k))));
+        side = _mm_or_ps(_mm_and_ps(side, one), _mm_andnot_ps(side, _mm_set1_ps(-1.0f)));
+        dx = _mm_or_ps(_mm_and_ps(same, side), _mm_andnot_ps(same, dx));
+        dy = _mm_andnot_ps(same, dy);
+        dist = _mm_or_ps(_mm_and_ps(same, one), _mm_andnot_ps(same, dist));
+        push = _mm_and_ps(push, _mm_div_ps(_mm_sub_ps(sepR, dist), _mm_mul_ps(sepR, dist)));
+        sepX = _mm_add_ps(sepX, _mm_mul_ps(dx, push));
+        sepY = _mm_add_ps(sepY, _mm_mul_ps(dy, push));
+
+        __m128i mate = _mm_and_si128(_mm_and_si128(live, _mm_cmpeq_epi32(kind, _mm_loadu_si128((const __m128i *)(flock.kind + k)))),
+                                     _mm_castps_si128(_mm_cmplt_ps(d2, radius2)));
+        __m128 mask = _mm_castsi128_ps(mate);
+        velX = _mm_add_ps(velX, _mm_and_ps(mask, _mm_loadu_ps(flock.vx + k)));
+        velY = _mm_add_ps(velY, _mm_and_ps(mask, _mm_loadu_ps(flock.vy + k)));
+        posX = _mm_add_ps(posX, _mm_and_ps(mask, _mm_loadu_ps(flock.x + k)));
+        posY = _mm_add_ps(posY, _mm_and_ps(mask, _mm_loadu_ps(flock.y + k)));
+        mates = _mm_sub_epi32(mates, mate);
+    }
+    _mm_storeu_ps(sums->sepX, sepX); _mm_storeu_ps(sums->sepY, sepY);
+    _mm_storeu_ps(sums->velX, velX); _mm_storeu_ps(sums->velY, velY);
+    _mm_storeu_ps(sums->posX, posX); _mm_storeu_ps(sums->posY, posY);
+    _mm_storeu_si128((__m128i *)sums->mates, mates);
+#endif
+    for (; k < to; k++)
+    {
+        int l = (k - from) & 3;
+        if (k == self) continue;
+        float dx = ex - flock.x[k];
+        float dy = ey - flock.y[k];
+        float d2 = dx*dx + dy*dy;
+        float sepR = esize + flock.size[k] + 8;
+
+        // only an actual push needs the distance, mates are picked on d2 alone
+        if (d2 < sepR * sepR)
         {
-            float maxX = enemies[i].boss ? 0.7f : (enemies[i].big ? 0.6f : 1.0f);
-            float maxY = enemies[i].boss ? 0.3f : (enemies[i].big ? 0.2f : 0.3f);
-            enemies[i].targetVel.x = GetRandomValue(-100,100)/100.0f * maxX;
-            enemies[i].targetVel.y = GetRandomValue(-100,100)/100.0f * maxY;
-            enemies[i].changeTimer = GetRandomValue(120,250)*0.01f;
+            float dist = sqrtf(d2);
+            if (dist < 0.01f) { dx = (flock.id[self] < flock.id[k]) ? 1.0f : -1.0f; dy = 0; dist = 1.0f; }
+            float push = (sepR - dist) / (sepR * dist);
+            sums->sepX[l] += dx * push;
+            sums->sepY[l] += dy * push;
         }
 
-        enemies[i].vel.x += (enemies[i].targetVel.x - enemies[i].vel.x) * 5 * dt;
-        enemies[i].vel.y += (enemies[i].targetVel.y - enemies[i].vel.y) * 5 * dt;
+        if (flock.kind[k] == flock.kind[self] && d2 < FLOCK_RADIUS * FLOCK_RADIUS)
+        {
+            sums->velX[l] += flock.vx[k]; sums->velY[l] += flock.vy[k];
+            sums->posX[l] += flock.x[k]; sums->posY[l] += flock.y[k];
+            sums->mates[l]++;
+        }
+    }
+}
 
-        enemies[i].pos.x += enemies[i].vel.x * enemies[i].speed * dt;
-        enemies[i].pos.y += enemies[i].vel.y * enemies[i].speed * dt;
+static float FlockFold(const float lanes[4]) { return ((lanes[0] + lanes[1]) + lanes[2]) + lanes[3]; }
 
-        if (enemies[i].pos.x < 100) { enemies[i].pos.x = 100; enemies[i].vel.x *= -0.6f; }
-        if (enemies[i].pos.x > w-100) { enemies[i].pos.x = w-100; enemies[i].vel.x *= -0.6f; }
-        if (enemies[i].pos.y < 100) { enemies[i].pos.y = 100; enemies[i].vel.y *= -0.6f; }
-        if (enemies[i].pos.y > fenceY-100) { enemies[i].pos.y = fenceY-100; enemies[i].vel.y *= -0.6f; }
+// separation from everyone close, alignment + cohesion only with the same kind
+// (smalls school together, bigs keep their own lane). reads positions from the
+// start of the tick so update order doesn't matter
+void UpdateFlocking(void)
+{
+    flockTick++;
+    memset(flockSteer, 0, sizeof(flockSteer));
 
-        float ratio = (float)enemies[i].health / enemies[i].maxHealth;
-        enemies[i].size = enemies[i].baseSize * (0.7f + 0.3f * ratio);
+    // walk the grid in cell order so the 3x3 block is worked out once per cell, not per enemy
+    for (int own = 0; own < gridCols * gridRows; own++)
+    {
+        if (gridStart[own] == gridStart[own + 1]) continue;
+        int cx = own % gridCols, cy = own / gridCols;
+
+        // cells under quota are scanned whole. crowded ones are read through a window that
+        // starts one slot later for each enemy in this cell and shifts every tick, so nobody
+        // is permanently left out of everyone else's samples
+        int first[9], count[9], take[9], cursor[9], cells = 0;
+        for (int n = 0; n < 9; n++)
+        {
+            int x = cx + n % 3 - 1, y = cy + n / 3 - 1;
+            if (x < 0 || x >= gridCols || y < 0 || y >= gridRows) continue;
+            int c = y * gridCols + x;
+            if (gridStart[c] == gridStart[c + 1]) continue;
+            first[cells] = gridStart[c];
+            count[cells] = gridStart[c + 1] - gridStart[c];
+            take[cells] = (c == own) ? FLOCK_OWN_SAMPLES : FLOCK_NEAR_SAMPLES;
+            if (take[cells] >= count[cells]) { take[cells] = count[cells]; cursor[cells] = 0; }
+            else cursor[cells] = (int)(flockTick * (unsigned int)take[cells] % (unsigned int)count[cells]);
+            cells++;
+        }
 
-        if (enemies[i].shakeTimer > 0)
+        for (int slot = gridStart[own]; slot < gridStart[own + 1]; slot++)
         {
-            enemies[i].shakeTimer -= dt;
-            enemies[i].shakeOffset.x = (GetRandomValue(-100,100)/100.0f) * 3;
-            enemies[i].shakeOffset.y = (GetRandomValue(-100,100)/100.0f) * 3;
+            FlockSums sums = {0};
+            for (int n = 0; n < cells; n++)
+            {
+                // the window may wrap past the end of the cell, then it is two spans
+                int from = first[n] + cursor[n], wrap = cursor[n] + take[n] - count[n];
+                FlockSpan(slot, from, wrap > 0 ? first[n] + count[n] : from + take[n], &sums);
+                if (wrap > 0) FlockSpan(slot, first[n], first[n] + wrap, &sums);
+                if (take[n] < count[n] && ++cursor[n] == count[n]) cursor[n] = 0;
+            }
+
+            int i = flock.id[slot];
+            int mates = sums.mates[0] + sums.mates[1] + sums.mates[2] + sums.mates[3];
+            flockSteer[i].x = FlockFold(sums.sepX) * FLOCK_SEPARATION;
+            flockSteer[i].y = FlockFold(sums.sepY) * FLOCK_SEPARATION;
+            if (mates > 0)
+            {
+                flockSteer[i].x += (FlockFold(sums.velX) / mates - flock.vx[slot]) * FLOCK_ALIGNMENT;
+                flockSteer[i].y += (FlockFold(sums.velY) / mates - flock.vy[slot]) * FLOCK_ALIGNMENT;
+                flockSteer[i].x += (FlockFold(sums.posX) / mates - flock.x[slot]) / FLOCK_RADIUS * FLOCK_COHESION;
+                flockSteer[i].y += (FlockFold(sums.posY) / mates - flock.y[slot]) / FLOCK_RADIUS * FLOCK_COHESION;
+            }
         }
-        else
+    }
+}
+
+void ResetEnemySchedule(void)
+{
+    for (int n = 0; n < MAX_ENEMIES * EV_COUNT; n++) wheelNodes[n] = (WheelNode){ .next = -1, .prev = -1, .slot = -1 };
+    for (int s = 0; s < WHEEL_SLOTS; s++) wheelHead[s] = -1;
+    wheelNow = 0;
+    wheelClock = 0;
+    shakeCount = 0;
+}
+
+void UnlinkWheelNode(int n)
+{
+    WheelNode *node = &wheelNodes[n];
+    if (node->slot < 0) return;
+    if (node->prev >= 0) wheelNodes[node->prev].next = node->next;
+    else wheelHead[node->slot] = node->next;
+    if (node->next >= 0) wheelNodes[node->next].prev = node->prev;
+    node->next = node->prev = node->slot = -1;
+}
+
+void LinkWheelNode(int n)
+{
+    WheelNode *node = &wheelNodes[n];
+    node->slot = node->due % WHEEL_SLOTS;
+    node->prev = -1;
+    node->next = wheelHead[node->slot];
+    if (node->next >= 0) wheelNodes[node->next].prev = n;
+    wheelHead[node->slot] = n;
+}
+
+// (re)scheduling replaces whatever that enemy had pending for the same event
+void ScheduleEnemy(int e, EnemyEvent ev, float delay)
+{
+    int n = e * EV_COUNT + ev;
+    UnlinkWheelNode(n);
+    unsigned int due = (unsigned int)ceilf((wheelClock + delay) / WHEEL_TICK);
+    wheelNodes[n].due = due > wheelNow ? due : wheelNow + 1;
+    LinkWheelNode(n);
+}
+
+void StartEnemyShake(int e, float duration)
+{
+    if (!enemies[e].shaking)
+    {
+        enemies[e].shaking = true;
+        shakeIndex[e] = shakeCount;
+        shakeList[shakeCount++] = e;
+    }
+    ScheduleEnemy(e, EV_SHAKE_END, duration);
+}
+
+void FireEnemyBullet(Vector2 pos, Vector2 vel)
+{
+    for (int j = 0; j < MAX_BULLETS; j++)
+    {
+        if (!bullets[j].active)
         {
-            enemies[i].shakeOffset = (Vector2){0,0};
+            bullets[j] = (Bullet){
+                .pos = pos,
+                .vel = vel,
+                .timer = 0,
+                .type = 0,
+                .active = true,
+                .player = false
+            };
+            break;
         }
+    }
+}
 
+void HandleEnemyEvent(int i, EnemyEvent ev)
+{
+    Enemy *e = &enemies[i];
+
+    if (ev == EV_SHAKE_END)
+    {
+        e->shaking = false;
+        e->shakeOffset = (Vector2){0,0};
+        int last = shakeList[--shakeCount];
+        shakeList[shakeIndex[i]] = last;
+        shakeIndex[last] = shakeIndex[i];
+        return;
+    }
+
+    if (!e->alive) return;  // dead enemies just let their events run out
+
+    if (ev == EV_REROLL)
+    {
+        float maxX = e->boss ? 0.7f : (e->big ? 0.6f : 1.0f);
+        float maxY = e->boss ? 0.3f : (e->big ? 0.2f : 0.3f);
+        e->targetVel.x = GetRandomValue(-100,100)/100.0f * maxX;
+        e->targetVel.y = GetRandomValue(-100,100)/100.0f * maxY;
+        ScheduleEnemy(i, EV_REROLL, GetRandomValue(120,250)*0.01f);
+    }
+    else if (ev == EV_SHOT)
+    {
         // ENEMIES ALWAYS SHOOT
-        if (enemies[i].big && !enemies[i].boss)
+        FireEnemyBullet(e->pos, (Vector2){0, 500});
+        ScheduleEnemy(i, EV_SHOT, 1.8f);
+    }
+    else if (ev == EV_BURST)
+    {
+        e->burstCount++;
+        if (e->burstCount <= 5)
         {
-            enemies[i].shootTimer += dt;
-            if (enemies[i].shootTimer > 1.8f)
-            {
-                for (int j = 0; j < MAX_BULLETS; j++)
-                {
-                    if (!bullets[j].active)
-                    {
-                        bullets[j] = (Bullet){
-                            .pos = enemies[i].pos,
-                            .vel = {0, 500},
-                            .timer = 0,
-                            .type = 0,
-                            .active = true,
-                            .player = false
-                        };
-                        break;
-                    }
-                }
-                enemies[i].shootTimer = 0;
-            }
+            Vector2 dir = { player.x - e->pos.x, player.y - e->pos.y };
+            float len = sqrtf(dir.x*dir.x + dir.y*dir.y);
+            if (len > 0) { dir.x /= len; dir.y /= len; }
+            FireEnemyBullet(e->pos, (Vector2){ dir.x * 600, dir.y * 600 });
+            ScheduleEnemy(i, EV_BURST, 0.65f);
         }
+        else
+        {
+            e->burstCount = 0;
+            ScheduleEnemy(i, EV_BURST, 0);
+        }
+    }
+}
+
+// walks every wheel tick that elapsed this frame. a bucket is taken off the
+// wheel whole, due nodes fire and the ones a lap (or more) out go back in
+void RunEnemySchedule(float dt)
+{
+    wheelClock += dt;
+    unsigned int target = (unsigned int)(wheelClock / WHEEL_TICK);
 
-        if (enemies[i].boss)
+    while (wheelNow < target)
+    {
+        wheelNow++;
+        int slot = wheelNow % WHEEL_SLOTS;
+        int n = wheelHead[slot];
+        wheelHead[slot] = -1;
+
+        while (n >= 0)
         {
-            enemies[i].shootTimer += dt;
-            if (enemies[i].shootTimer > 0.8f)
-            {
-                enemies[i].burstCount++;
-                if (enemies[i].burstCount <= 5)
-                {
-                    for (int j = 0; j < MAX_BULLETS; j++)
-                    {
-                        if (!bullets[j].active)
-                        {
-                            Vector2 dir = { player.x - enemies[i].pos.x, player.y - enemies[i].pos.y };
-                            float len = sqrtf(dir.x*dir.x + dir.y*dir.y);
-                            if (len > 0) { dir.x /= len; dir.y /= len; }
-                            bullets[j] = (Bullet){
-                                .pos = enemies[i].pos,
-                                .vel = { dir.x * 600, dir.y * 600 },
-                                .timer = 0,
-                                .type = 0,
-                                .active = true,
-                                .player = false
-                            };
-                            break;
-                        }
-                    }
-                    enemies[i].shootTimer = 0.15f;
-                }
-                else
-                {
-                    enemies[i].burstCount = 0;
-                    enemies[i].shootTimer = 2.0f;
-                }
-            }
+            int next = wheelNodes[n].next;
+            wheelNodes[n].next = wheelNodes[n].prev = wheelNodes[n].slot = -1;
+            if (wheelNodes[n].due > wheelNow) LinkWheelNode(n);
+            else HandleEnemyEvent(n / EV_COUNT, (EnemyEvent)(n % EV_COUNT));
+            n = next;
         }
     }
 }
 
+void UpdateEnemies(float dt)
+{
+    BuildEnemyGrid();
+    UpdateFlocking();
+    RunEnemySchedule(dt);
+
+    for (int i = 0; i < MAX_ENEMIES; i++)
+    {
+        if (!enemies[i].alive) continue;
+
+        enemies[i].vel.x += (enemies[i].targetVel.x - enemies[i].vel.x) * 5 * dt;
+        enemies[i].vel.y += (enemies[i].targetVel.y - enemies[i].vel.y) * 5 * dt;
+        enemies[i].vel.x += flockSteer[i].x * dt;
+        enemies[i].vel.y += flockSteer[i].y * dt;
+
+        enemies[i].pos.x += enemies[i].vel.x * enemies[i].speed * dt;
+        enemies[i].pos.y += enemies[i].vel.y * enemies[i].speed * dt;
+
+        if (enemies[i].pos.x < 100) { enemies[i].pos.x = 100; enemies[i].vel.x *= -0.6f; }
+        if (enemies[i].pos.x > w-100) { enemies[i].pos.x = w-100; enemies[i].vel.x *= -0.6f; }
+        if (enemies[i].pos.y < 100) { enemies[i].pos.y = 100; enemies[i].vel.y *= -0.6f; }
+        if (enemies[i].pos.y > fenceY-100) { enemies[i].pos.y = fenceY-100; enemies[i].vel.y *= -0.6f; }
+
+        float ratio = (float)enemies[i].health / enemies[i].maxHealth;
+        enemies[i].size = enemies[i].baseSize * (0.7f + 0.3f * ratio);
+    }
+}
+
 void HandleCollisions(float dt)
 {
     for (int b = 0; b < MAX_BULLETS; b++)
@@ -552,7 +906,7 @@ void HandleCollisions(float dt)
                 if (CheckCollisionCircles(bullets[b].pos, 8, enemies[e].pos, enemies[e].size))
                 {
                     enemies[e].health--;
-                    enemies[e].shakeTimer = 0.1f;
+                    StartEnemyShake(e, 0.1f);
                     if (enemies[e].health <= 0)
                     {
                         enemies[e].alive = false;
@@ -603,7 +957,7 @@ void HandleCollisions(float dt)
                 if (CheckCollisionCircleRec(enemies[e].pos, enemies[e].size, beam))
                 {
                     enemies[e].health -= 20 * dt;
-                    enemies[e].shakeTimer = 0.05f;
+                    StartEnemyShake(e, 0.05f);
                     if (enemies[e].health <= 0)
                     {
                         enemies[e].alive = false;
@@ -618,6 +972,85 @@ void HandleCollisions(float dt)
     }
 }
 
+// cosmetic randomness has its own generator so dropping effects can never
+// shift the GetRandomValue sequence gameplay runs on
+int FxRandom(int min, int max)
+{
+    fxSeed ^= fxSeed << 13;
+    fxSeed ^= fxSeed >> 17;
+    fxSeed ^= fxSeed << 5;
+    return min + (int)(fxSeed % (unsigned int)(max - min + 1));
+}
+
+void InitGovernor(void)
+{
+    gov = (Governor){ .tier = FX_FULL, .headroom = FRAME_BUDGET };
+#ifdef HEADLESS
+    // golden frames can't depend on how fast the CI box is
+    gov.locked = true;
+    gov.tier = SrEnvInt("ONESHOT_FX_TIER", FX_FULL);
+    if (gov.tier < FX_FULL) gov.tier = FX_FULL;
+    if (gov.tier > FX_TIERS - 1) gov.tier = FX_TIERS - 1;
+#endif
+}
+
+void UpdateGovernor(double simTime, double renderTime)
+{
+    gov.cost += ((float)(simTime + renderTime) - gov.cost) * 0.1f;
+    gov.headroom = FRAME_BUDGET - gov.cost;
+    if (gov.locked) return;
+
+    gov.overFrames = gov.cost > FRAME_BUDGET * FX_STEP_DOWN ? gov.overFrames + 1 : 0;
+    gov.underFrames = gov.cost < FRAME_BUDGET * FX_STEP_UP ? gov.underFrames + 1 : 0;
+
+    if (gov.overFrames >= FX_DOWN_FRAMES && gov.tier < FX_TIERS - 1)
+    {
+        gov.tier++;
+        gov.overFrames = gov.underFrames = 0;
+    }
+    else if (gov.underFrames >= FX_UP_FRAMES && gov.tier > FX_FULL)
+    {
+        gov.tier--;
+        gov.overFrames = gov.underFrames = 0;
+    }
+}
+
+// spinner, explosion fade and shake jitter. on the lowest tier they only tick at 30 Hz
+void UpdateCosmetics(float dt)
+{
+    gov.cosmeticTime += dt;
+    if (gov.tier >= FX_LOW_RATE && gov.cosmeticTime < FX_LOW_RATE_STEP) return;
+    float step = gov.cosmeticTime;
+    gov.cosmeticTime = 0;
+
+    spinAngle += 180 * step;
+
+    for (int i = 0; i < MAX_EXPLOSIONS; i++)
+    {
+        if (!explosions[i].active) continue;
+        explosions[i].timer -= step;
+        if (explosions[i].timer <= 0) explosions[i].active = false;
+    }
+
+    bool shake = gov.tier < FX_NO_SHAKE;
+    if (playerShakeTimer > 0 && shake)
+    {
+        playerShakeOffset.x = (FxRandom(-100,100)/100.0f) * 4;
+        playerShakeOffset.y = (FxRandom(-100,100)/100.0f) * 4;
+    }
+    else
+    {
+        playerShakeOffset = (Vector2){0,0};
+    }
+
+    for (int k = 0; k < shakeCount; k++)
+    {
+        Enemy *e = &enemies[shakeList[k]];
+        e->shakeOffset.x = shake ? (FxRandom(-100,100)/100.0f) * 3 : 0;
+        e->shakeOffset.y = shake ? (FxRandom(-100,100)/100.0f) * 3 : 0;
+    }
+}
+
 void DrawPlayer(void)
 {
     Vector2 drawPos = { player.x + playerShakeOffset.x, player.y + playerShakeOffset.y };
@@ -648,6 +1081,10 @@ void DrawHUD(void)
     DrawText(TextFormat("GOLD: %d", gold), 20, 20, 30, YELLOW);
     DrawText(TextFormat("AMMO: %d", ammo), 20, 60, 30, ammo > 0 ? GREEN : RED);
     if (devMode) DrawText("DEV MODE", w - 210, 20, 40, RED);
+    if (capture.running) DrawText(TextFormat("REC %d  DROPPED %d", capture.captured, capture.dropped), w - 300, 70, 24, RED);
+    Color fxColor = gov.tier == FX_FULL ? GREEN : gov.tier < FX_NO_SHAKE ? YELLOW : ORANGE;
+    if (gov.locked) DrawText(TextFormat("FX TIER %d (LOCKED)", gov.tier), 20, 100, 20, fxColor);
+    else DrawText(TextFormat("FX TIER %d  HEADROOM %+.1f MS", gov.tier, gov.headroom * 1000), 20, 100, 20, fxColor);
     DrawText("Press M to return to menu", w - 300, h - 30, 20, Fade(WHITE, 0.6f));
 }
 
@@ -717,30 +1154,34 @@ void DrawGame(void)
         Vector2 drawPos = { enemies[i].pos.x + enemies[i].shakeOffset.x, enemies[i].pos.y + enemies[i].shakeOffset.y };
         DrawCircleV(drawPos, enemies[i].size, enemies[i].color);
 
-        if (enemies[i].boss)
-            DrawText("DADDY", drawPos.x - 35, drawPos.y - 15, 24, WHITE);
-        else if (enemies[i].big)
-            DrawText("15", drawPos.x - 15, drawPos.y - 15, 24, WHITE);
-        else
-            DrawText("2", drawPos.x - 8, drawPos.y - 10, 20, WHITE);
+        if (gov.tier < FX_NO_LABELS)
+        {
+            if (enemies[i].boss)
+                DrawText("DADDY", drawPos.x - 35, drawPos.y - 15, 24, WHITE);
+            else if (enemies[i].big)
+                DrawText("15", drawPos.x - 15, drawPos.y - 15, 24, WHITE);
+            else
+                DrawText("2", drawPos.x - 8, drawPos.y - 10, 20, WHITE);
+        }
 
-        if (enemies[i].shakeTimer > 0)
+        if (enemies[i].shaking)
         {
-            for (int s = 0; s < 3; s++)
+            int sparks = gov.tier < FX_THIN_PARTICLES ? 3 : 1;
+            for (int s = 0; s < sparks; s++)
             {
-                Vector2 spark = { drawPos.x + GetRandomValue(-20,20), drawPos.y + GetRandomValue(-20,20) };
+                Vector2 spark = { drawPos.x + FxRandom(-20,20), drawPos.y + FxRandom(-20,20) };
                 DrawPixelV(spark, YELLOW);
             }
         }
     }
 
+    // thinned: every fireball still shows, drawn at 0.7 of the radius (about half the blended area)
+    float fireball = gov.tier < FX_THIN_PARTICLES ? 180 : 126;
     for (int i = 0; i < MAX_EXPLOSIONS; i++)
         if (explosions[i].active)
         {
-            float r = 180 * (explosions[i].timer/0.4f);
+            float r = fireball * (explosions[i].timer/0.4f);
             DrawCircleV(explosions[i].pos, r, Fade(ORANGE, explosions[i].timer/0.4f));
-            explosions[i].timer -= GetFrameTime();
-            if (explosions[i].timer <= 0) explosions[i].active = false;
         }
 
     if (countdown > 0)
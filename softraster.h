@@ -0,0 +1,586 @@
+// Authors: Matthew Johnson and Nathan Ly
+// GameJam
+// Headless software backend. Build the game with -DHEADLESS and every raylib draw call
+// lands here instead of the GPU, so frames can be rendered and diffed on machines with no display.
+// gcc -DHEADLESS -O2 -o oneshot_headless oneshotv1.c -lraylib -lm -lpthread -ldl -lrt
+//
+// ONESHOT_REPLAY=file   input script, one line per run of frames: "<frames> <keys...>" (e.g. "30 W E", "5 -"),
+//                       "#" starts a comment; replays/tour.txt visits every screen
+// ONESHOT_FRAMES=n      frames to render when there is no replay (default 1)
+// ONESHOT_RECORD=dir    write every frame as dir/frame_00000.png (makes new goldens)
+// ONESHOT_GOLDEN=dir    diff every frame that has a dir/frame_00000.png, failures get a .actual.png next to it.
+//                       the run fails if nothing was compared or it ended before the last golden
+// ONESHOT_TOLERANCE=n   per channel difference allowed when diffing (default 0)
+// ONESHOT_THREADS=n     raster threads including the main one (default: all cores)
+// ONESHOT_SEED=n        random seed (default 1)
+// ONESHOT_FX_TIER=n     effect quality tier 0-4, fixed so frames don't depend on host speed (default 0)
+
+#ifndef SOFTRASTER_H
+#define SOFTRASTER_H
+
+#include "raylib.h"
+#include "rlgl.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define SR_TILE_W       128
+#define SR_TILE_H       32
+#define SR_MAX_THREADS  16
+#define SR_MAX_POLY     12
+#define SR_MAX_KEYS     512
+
+typedef enum { SR_RECT, SR_CIRCLE, SR_RING, SR_POLY } SrShape;
+
+// color prepared once per draw call: packed RGBA for opaque stores, and
+// premultiplied 16 bit channels for blending (out = (src*a + dst*(255-a)) / 255)
+typedef struct {
+    uint32_t packed;
+    int alpha;
+    uint16_t mul[4];
+} SrPaint;
+
+typedef struct {
+    SrShape shape;
+    SrPaint paint;
+    int x0, y0, x1, y1;
+    float cx, cy, r0, r1;
+    float a0, a1;
+    int sides;
+    Vector2 verts[SR_MAX_POLY];
+} SrCmd;
+
+typedef struct {
+    int w, h;
+    uint32_t *pixels;
+    SrCmd *cmds;
+    int cmdCount, cmdCap;
+    int tilesX, tilesY;
+    atomic_int nextTile;
+
+    pthread_t threads[SR_MAX_THREADS];
+    int threadCount;
+    pthread_mutex_t lock;
+    pthread_cond_t start, done;
+    int generation, busy;
+    bool quit;
+
+    FILE *replay;
+    int holdFrames;
+    bool keyDown[SR_MAX_KEYS], keyPrev[SR_MAX_KEYS];
+    int framesLeft;
+
+    const char *recordDir, *goldenDir;
+    int tolerance;
+    int frame, compared, failed;
+    int rastered;   // commands of this frame already on the framebuffer
+    double rasterTime;
+} SoftRaster;
+
+static SoftRaster sr;
+
+static const unsigned char srFont[95][5] = {
+    {0x00,0x00,0x00,0x00,0x00},{0x00,0x00,0x5F,0x00,0x00},{0x00,0x07,0x00,0x07,0x00},{0x14,0x7F,0x14,0x7F,0x14},
+    {0x24,0x2A,0x7F,0x2A,0x12},{0x23,0x13,0x08,0x64,0x62},{0x36,0x49,0x56,0x20,0x50},{0x00,0x05,0x03,0x00,0x00},
+    {0x00,0x1C,0x22,0x41,0x00},{0x00,0x41,0x22,0x1C,0x00},{0x14,0x08,0x3E,0x08,0x14},{0x08,0x08,0x3E,0x08,0x08},
+    {0x00,0x50,0x30,0x00,0x00},{0x08,0x08,0x08,0x08,0x08},{0x00,0x60,0x60,0x00,0x00},{0x20,0x10,0x08,0x04,0x02},
+    {0x3E,0x51,0x49,0x45,0x3E},{0x00,0x42,0x7F,0x40,0x00},{0x42,0x61,0x51,0x49,0x46},{0x21,0x41,0x45,0x4B,0x31},
+    {0x18,0x14,0x12,0x7F,0x10},{0x27,0x45,0x45,0x45,0x39},{0x3C,0x4A,0x49,0x49,0x30},{0x01,0x71,0x09,0x05,0x03},
+    {0x36,0x49,0x49,0x49,0x36},{0x06,0x49,0x49,0x29,0x1E},{0x00,0x36,0x36,0x00,0x00},{0x00,0x56,0x36,0x00,0x00},
+    {0x08,0x14,0x22,0x41,0x00},{0x14,0x14,0x14,0x14,0x14},{0x00,0x41,0x22,0x14,0x08},{0x02,0x01,0x51,0x09,0x06},
+    {0x32,0x49,0x79,0x41,0x3E},{0x7E,0x11,0x11,0x11,0x7E},{0x7F,0x49,0x49,0x49,0x36},{0x3E,0x41,0x41,0x41,0x22},
+    {0x7F,0x41,0x41,0x22,0x1C},{0x7F,0x49,0x49,0x49,0x41},{0x7F,0x09,0x09,0x09,0x01},{0x3E,0x41,0x49,0x49,0x7A},
+    {0x7F,0x08,0x08,0x08,0x7F},{0x00,0x41,0x7F,0x41,0x00},{0x20,0x40,0x41,0x3F,0x01},{0x7F,0x08,0x14,0x22,0x41},
+    {0x7F,0x40,0x40,0x40,0x40},{0x7F,0x02,0x0C,0x02,0x7F},{0x7F,0x04,0x08,0x10,0x7F},{0x3E,0x41,0x41,0x41,0x3E},
+    {0x7F,0x09,0x09,0x09,0x06},{0x3E,0x41,0x51,0x21,0x5E},{0x7F,0x09,0x19,0x29,0x46},{0x46,0x49,0x49,0x49,0x31},
+    {0x01,0x01,0x7F,0x01,0x01},{0x3F,0x40,0x40,0x40,0x3F},{0x1F,0x20,0x40,0x20,0x1F},{0x3F,0x40,0x38,0x40,0x3F},
+    {0x63,0x14,0x08,0x14,0x63},{0x07,0x08,0x70,0x08,0x07},{0x61,0x51,0x49,0x45,0x43},{0x00,0x7F,0x41,0x41,0x00},
+    {0x02,0x04,0x08,0x10,0x20},{0x00,0x41,0x41,0x7F,0x00},{0x04,0x02,0x01,0x02,0x04},{0x40,0x40,0x40,0x40,0x40},
+    {0x00,0x01,0x02,0x04,0x00},{0x20,0x54,0x54,0x54,0x78},{0x7F,0x48,0x44,0x44,0x38},{0x38,0x44,0x44,0x44,0x20},
+    {0x38,0x44,0x44,0x48,0x7F},{0x38,0x54,0x54,0x54,0x18},{0x08,0x7E,0x09,0x01,0x02},{0x0C,0x52,0x52,0x52,0x3E},
+    {0x7F,0x08,0x04,0x04,0x78},{0x00,0x44,0x7D,0x40,0x00},{0x20,0x40,0x44,0x3D,0x00},{0x7F,0x10,0x28,0x44,0x00},
+    {0x00,0x41,0x7F,0x40,0x00},{0x7C,0x04,0x18,0x04,0x78},{0x7C,0x08,0x04,0x04,0x78},{0x38,0x44,0x44,0x44,0x38},
+    {0x7C,0x14,0x14,0x14,0x08},{0x08,0x14,0x14,0x18,0x7C},{0x7C,0x08,0x04,0x04,0x08},{0x48,0x54,0x54,0x54,0x20},
+    {0x04,0x3F,0x44,0x40,0x20},{0x3C,0x40,0x40,0x20,0x7C},{0x1C,0x20,0x40,0x20,0x1C},{0x3C,0x40,0x30,0x40,0x3C},
+    {0x44,0x28,0x10,0x28,0x44},{0x0C,0x50,0x50,0x50,0x3C},{0x44,0x64,0x54,0x4C,0x44},{0x00,0x08,0x36,0x41,0x00},
+    {0x00,0x00,0x7F,0x00,0x00},{0x00,0x41,0x36,0x08,0x00},{0x10,0x08,0x08,0x10,0x08}
+};
+
+static SrPaint SrMakePaint(Color c)
+{
+    SrPaint p = { .packed = (uint32_t)c.r | ((uint32_t)c.g << 8) | ((uint32_t)c.b << 16) | 0xFF000000u, .alpha = c.a };
+    p.mul[0] = c.r * c.a; p.mul[1] = c.g * c.a; p.mul[2] = c.b * c.a; p.mul[3] = 255 * c.a;
+    return p;
+}
+
+// fills [x0, x1) of one row. opaque colors are plain 4-pixel stores, translucent ones
+// blend 4 pixels at a time; the scalar tail uses the exact same math so SIMD and
+// non-SIMD builds produce identical goldens
+static void SrFillSpan(uint32_t *row, int x0, int x1, const SrPaint *p)
+{
+    if (x0 >= x1 || p->alpha == 0) return;
+    int x = x0;
+
+    if (p->alpha == 255)
+    {
+#if defined(__SSE2__)
+        __m128i c4 = _mm_set1_epi32((int)p->packed);
+        for (; x + 4 <= x1; x += 4) _mm_storeu_si128((__m128i *)(row + x), c4);
+#endif
+        for (; x < x1; x++) row[x] = p->packed;
+        return;
+    }
+
+    int inv = 255 - p->alpha;
+#if defined(__SSE2__)
+    __m128i zero = _mm_setzero_si128();
+    __m128i mul = _mm_setr_epi16(p->mul[0], p->mul[1], p->mul[2], p->mul[3], p->mul[0], p->mul[1], p->mul[2], p->mul[3]);
+    __m128i invA = _mm_set1_epi16((short)inv);
+    __m128i one = _mm_set1_epi16(1);
+    for (; x + 4 <= x1; x += 4)
+    {
+        __m128i d = _mm_loadu_si128((__m128i *)(row + x));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), invA), mul);
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), invA), mul);
+        // v / 255 == (v + 1 + (v >> 8)) >> 8 for every v this can produce
+        lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+        _mm_storeu_si128((__m128i *)(row + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; x < x1; x++)
+    {
+        uint32_t d = row[x], out = 0;
+        for (int c = 0; c < 4; c++)
+        {
+            unsigned v = ((d >> (c * 8)) & 0xFF) * inv + p->mul[c];
+            out |= (uint32_t)((v + 1 + (v >> 8)) >> 8) << (c * 8);
+        }
+        row[x] = out;
+    }
+}
+
+// pixel x is covered when its center x + 0.5 lies in [left, right)
+static void SrFillRange(uint32_t *row, float left, float right, int clipX0, int clipX1, const SrPaint *p)
+{
+    int x0 = (int)ceilf(left - 0.5f), x1 = (int)ceilf(right - 0.5f);
+    if (x0 < clipX0) x0 = clipX0;
+    if (x1 > clipX1) x1 = clipX1;
+    SrFillSpan(row, x0, x1, p);
+}
+
+static bool SrInArc(float dx, float dy, float a0, float a1)
+{
+    float lo = fminf(a0, a1), hi = fmaxf(a0, a1);
+    if (hi - lo >= 360.0f) return true;
+    float t = fmodf(atan2f(dy, dx) * RAD2DEG - lo, 360.0f);
+    if (t < 0) t += 360.0f;
+    return t <= hi - lo;
+}
+
+static void SrRasterCmd(const SrCmd *c, int tx0, int ty0, int tx1, int ty1)
+{
+    int x0 = c->x0 > tx0 ? c->x0 : tx0, x1 = c->x1 < tx1 ? c->x1 : tx1;
+    int y0 = c->y0 > ty0 ? c->y0 : ty0, y1 = c->y1 < ty1 ? c->y1 : ty1;
+    if (x0 >= x1 || y0 >= y1) return;
+
+    for (int y = y0; y < y1; y++)
+    {
+        uint32_t *row = sr.pixels + (size_t)y * sr.w;
+        float dy = y + 0.5f - c->cy;
+
+        if (c->shape == SR_RECT) SrFillSpan(row, x0, x1, &c->paint);
+        else if (c->shape == SR_CIRCLE)
+        {
+            if (fabsf(dy) >= c->r1) continue;
+            float hw = sqrtf(c->r1*c->r1 - dy*dy);
+            SrFillRange(row, c->cx - hw, c->cx + hw, x0, x1, &c->paint);
+        }
+        else if (c->shape == SR_RING)
+        {
+            if (fabsf(dy) >= c->r1) continue;
+            float ho = sqrtf(c->r1*c->r1 - dy*dy);
+            float hi = fabsf(dy) < c->r0 ? sqrtf(c->r0*c->r0 - dy*dy) : 0;
+            float spans[2][2] = { { c->cx - ho, c->cx - hi }, { c->cx + hi, c->cx + ho } };
+            for (int s = 0; s < 2; s++)
+            {
+                int sx0 = (int)ceilf(spans[s][0] - 0.5f), sx1 = (int)ceilf(spans[s][1] - 0.5f);
+                if (sx0 < x0) sx0 = x0;
+                if (sx1 > x1) sx1 = x1;
+                // partial rings break the span into runs of pixels inside the arc
+                int run = -1;
+                for (int x = sx0; x < sx1; x++)
+                {
+                    bool in = SrInArc(x + 0.5f - c->cx, dy, c->a0, c->a1);
+                    if (in && run < 0) run = x;
+                    if (!in && run >= 0) { SrFillSpan(row, run, x, &c->paint); run = -1; }
+                }
+                if (run >= 0) SrFillSpan(row, run, sx1, &c->paint);
+            }
+        }
+        else if (c->shape == SR_POLY)
+        {
+            float yc = y + 0.5f, left = 1e9f, right = -1e9f;
+            for (int i = 0; i < c->sides; i++)
+            {
+                Vector2 a = c->verts[i], b = c->verts[(i + 1) % c->sides];
+                if ((a.y <= yc && yc < b.y) || (b.y <= yc && yc < a.y))
+                {
+                    float x = a.x + (yc - a.y) * (b.x - a.x) / (b.y - a.y);
+                    left = fminf(left, x);
+                    right = fmaxf(right, x);
+                }
+            }
+            if (left < right) SrFillRange(row, left, right, x0, x1, &c->paint);
+        }
+    }
+}
+
+// every thread grabs tiles until none are left; a tile walks the not yet rasterized
+// commands in order so overlapping alpha draws blend exactly like the GPU path
+static void SrRunTiles(void)
+{
+    int tiles = sr.tilesX * sr.tilesY;
+    for (int t = atomic_fetch_add(&sr.nextTile, 1); t < tiles; t = atomic_fetch_add(&sr.nextTile, 1))
+    {
+        int tx0 = (t % sr.tilesX) * SR_TILE_W, ty0 = (t / sr.tilesX) * SR_TILE_H;
+        int tx1 = tx0 + SR_TILE_W < sr.w ? tx0 + SR_TILE_W : sr.w;
+        int ty1 = ty0 + SR_TILE_H < sr.h ? ty0 + SR_TILE_H : sr.h;
+        for (int i = sr.rastered; i < sr.cmdCount; i++) SrRasterCmd(&sr.cmds[i], tx0, ty0, tx1, ty1);
+    }
+}
+
+static void *SrWorker(void *arg)
+{
+    (void)arg;
+    int seen = 0;
+    for (;;)
+    {
+        pthread_mutex_lock(&sr.lock);
+        while (sr.generation == seen && !sr.quit) pthread_cond_wait(&sr.start, &sr.lock);
+        if (sr.quit) { pthread_mutex_unlock(&sr.lock); return NULL; }
+        seen = sr.generation;
+        pthread_mutex_unlock(&sr.lock);
+
+        SrRunTiles();
+
+        pthread_mutex_lock(&sr.lock);
+        if (--sr.busy == 0) pthread_cond_signal(&sr.done);
+        pthread_mutex_unlock(&sr.lock);
+    }
+}
+
+static double SrNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int SrEnvInt(const char *name, int fallback)
+{
+    const char *v = getenv(name);
+    return v ? atoi(v) : fallback;
+}
+
+static void SrPush(SrCmd c)
+{
+    if (c.x0 < 0) c.x0 = 0;
+    if (c.y0 < 0) c.y0 = 0;
+    if (c.x1 > sr.w) c.x1 = sr.w;
+    if (c.y1 > sr.h) c.y1 = sr.h;
+    if (c.x0 >= c.x1 || c.y0 >= c.y1 || c.paint.alpha == 0) return;
+
+    if (sr.cmdCount == sr.cmdCap)
+    {
+        sr.cmdCap = sr.cmdCap ? sr.cmdCap * 2 : 1024;
+        sr.cmds = realloc(sr.cmds, sizeof(SrCmd) * sr.cmdCap);
+    }
+    sr.cmds[sr.cmdCount++] = c;
+}
+
+static void SrInit(int width, int height, const char *title)
+{
+    (void)title;
+    sr.w = width; sr.h = height;
+    sr.pixels = calloc((size_t)width * height, sizeof(uint32_t));
+    sr.tilesX = (width + SR_TILE_W - 1) / SR_TILE_W;
+    sr.tilesY = (height + SR_TILE_H - 1) / SR_TILE_H;
+
+    sr.recordDir = getenv("ONESHOT_RECORD");
+    sr.goldenDir = getenv("ONESHOT_GOLDEN");
+    sr.tolerance = SrEnvInt("ONESHOT_TOLERANCE", 0);
+    sr.framesLeft = SrEnvInt("ONESHOT_FRAMES", 1);
+    const char *replay = getenv("ONESHOT_REPLAY");
+    if (replay && !(sr.replay = fopen(replay, "r"))) TraceLog(LOG_ERROR, "HEADLESS: can't open replay %s", replay);
+    SetRandomSeed(SrEnvInt("ONESHOT_SEED", 1));
+
+    int threads = SrEnvInt("ONESHOT_THREADS", (int)sysconf(_SC_NPROCESSORS_ONLN));
+    if (threads < 1) threads = 1;
+    if (threads > SR_MAX_THREADS) threads = SR_MAX_THREADS;
+    pthread_mutex_init(&sr.lock, NULL);
+    pthread_cond_init(&sr.start, NULL);
+    pthread_cond_init(&sr.done, NULL);
+    for (int i = 0; i < threads - 1; i++)
+        if (pthread_create(&sr.threads[sr.threadCount], NULL, SrWorker, NULL) == 0) sr.threadCount++;
+}
+
+static int SrKeyFromName(const char *name)
+{
+    if (strlen(name) == 1 && ((name[0] >= 'A' && name[0] <= 'Z') || (name[0] >= '0' && name[0] <= '9'))) return name[0];
+    if (!strcmp(name, "ENTER")) return KEY_ENTER;
+    if (!strcmp(name, "SPACE")) return KEY_SPACE;
+    if (!strcmp(name, "UP")) return KEY_UP;
+    if (!strcmp(name, "DOWN")) return KEY_DOWN;
+    if (!strcmp(name, "LEFT")) return KEY_LEFT;
+    if (!strcmp(name, "RIGHT")) return KEY_RIGHT;
+    if (!strcmp(name, "F9")) return KEY_F9;
+    return -1;
+}
+
+// advances input by one frame; the game is over when the replay (or frame budget) runs out
+static bool SrWindowShouldClose(void)
+{
+    memcpy(sr.keyPrev, sr.keyDown, sizeof(sr.keyDown));
+    if (!sr.replay) return sr.framesLeft-- <= 0;
+
+    char line[256];
+    while (sr.holdFrames <= 0)
+    {
+        if (!fgets(line, sizeof(line), sr.replay)) return true;
+        char *tok = strtok(line, " \t\r\n");
+        if (!tok || tok[0] == '#') continue;
+        sr.holdFrames = atoi(tok);
+        memset(sr.keyDown, 0, sizeof(sr.keyDown));
+        while ((tok = strtok(NULL, " \t\r\n")))
+        {
+            int key = SrKeyFromName(tok);
+            if (key >= 0 && key < SR_MAX_KEYS) sr.keyDown[key] = true;
+            else if (tok[0] != '-') TraceLog(LOG_WARNING, "HEADLESS: unknown key %s in replay", tok);
+        }
+    }
+    sr.holdFrames--;
+    return false;
+}
+
+static bool SrIsKeyDown(int key) { return key >= 0 && key < SR_MAX_KEYS && sr.keyDown[key]; }
+static bool SrIsKeyPressed(int key) { return SrIsKeyDown(key) && !sr.keyPrev[key]; }
+
+static void SrBeginDrawing(void) { sr.cmdCount = 0; sr.rastered = 0; }
+
+static void SrClearBackground(Color c)
+{
+    c.a = 255;
+    SrPush((SrCmd){ .shape = SR_RECT, .paint = SrMakePaint(c), .x0 = 0, .y0 = 0, .x1 = sr.w, .y1 = sr.h });
+}
+
+static void SrDrawRectangle(int x, int y, int width, int height, Color c)
+{
+    SrPush((SrCmd){ .shape = SR_RECT, .paint = SrMakePaint(c), .x0 = x, .y0 = y, .x1 = x + width, .y1 = y + height });
+}
+
+static void SrDrawPixel(int x, int y, Color c) { SrDrawRectangle(x, y, 1, 1, c); }
+static void SrDrawPixelV(Vector2 p, Color c) { SrDrawRectangle((int)floorf(p.x), (int)floorf(p.y), 1, 1, c); }
+
+static void SrDrawCircleV(Vector2 center, float radius, Color c)
+{
+    SrPush((SrCmd){ .shape = SR_CIRCLE, .paint = SrMakePaint(c), .cx = center.x, .cy = center.y, .r1 = radius,
+        .x0 = (int)floorf(center.x - radius), .y0 = (int)floorf(center.y - radius),
+        .x1 = (int)ceilf(center.x + radius) + 1, .y1 = (int)ceilf(center.y + radius) + 1 });
+}
+
+static void SrDrawCircle(int x, int y, float radius, Color c) { SrDrawCircleV((Vector2){ x, y }, radius, c); }
+
+static void SrDrawRing(Vector2 center, float inner, float outer, float startAngle, float endAngle, int segments, Color c)
+{
+    (void)segments;
+    SrPush((SrCmd){ .shape = SR_RING, .paint = SrMakePaint(c), .cx = center.x, .cy = center.y, .r0 = inner, .r1 = outer,
+        .a0 = startAngle, .a1 = endAngle,
+        .x0 = (int)floorf(center.x - outer), .y0 = (int)floorf(center.y - outer),
+        .x1 = (int)ceilf(center.x + outer) + 1, .y1 = (int)ceilf(center.y + outer) + 1 });
+}
+
+static void SrDrawPoly(Vector2 center, int sides, float radius, float rotation, Color c)
+{
+    if (sides < 3) sides = 3;
+    if (sides > SR_MAX_POLY) sides = SR_MAX_POLY;
+    SrCmd cmd = { .shape = SR_POLY, .paint = SrMakePaint(c), .sides = sides, .cy = center.y,
+        .x0 = (int)floorf(center.x - radius), .y0 = (int)floorf(center.y - radius),
+        .x1 = (int)ceilf(center.x + radius) + 1, .y1 = (int)ceilf(center.y + radius) + 1 };
+    for (int i = 0; i < sides; i++)
+    {
+        float a = (rotation + i * 360.0f / sides) * DEG2RAD;
+        cmd.verts[i] = (Vector2){ center.x + cosf(a) * radius, center.y + sinf(a) * radius };
+    }
+    SrPush(cmd);
+}
+
+// 5x7 bitmap font scaled like raylib's default font (10px base size, 1px spacing per 10px);
+// each lit column run becomes one rectangle
+static void SrDrawText(const char *text, int x, int y, int fontSize, Color c)
+{
+    int scale = fontSize / 10 > 0 ? fontSize / 10 : 1;
+    int penX = x, penY = y;
+    for (const char *ch = text; *ch; ch++)
+    {
+        if (*ch == '\n') { penX = x; penY += 10 * scale; continue; }
+        if (*ch >= 32 && *ch < 127)
+        {
+            const unsigned char *glyph = srFont[*ch - 32];
+            for (int col = 0; col < 5; col++)
+            {
+                for (int row = 0; row < 7; row++)
+                {
+                    if (!(glyph[col] & (1 << row))) continue;
+                    int run = row;
+                    while (row + 1 < 7 && (glyph[col] & (1 << (row + 1)))) row++;
+                    SrDrawRectangle(penX + col * scale, penY + run * scale, scale, (row - run + 1) * scale, c);
+                }
+            }
+        }
+        penX += 6 * scale;
+    }
+}
+
+static void SrDiffGolden(void)
+{
+    const char *path = TextFormat("%s/frame_%05d.png", sr.goldenDir, sr.frame);
+    if (!FileExists(path)) return;
+
+    Image golden = LoadImage(path);
+    ImageFormat(&golden, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    int bad = 0;
+    if (golden.width != sr.w || golden.height != sr.h) bad = sr.w * sr.h;
+    else
+    {
+        const unsigned char *a = golden.data, *b = (const unsigned char *)sr.pixels;
+        for (int i = 0; i < sr.w * sr.h * 4; i += 4)
+            for (int c = 0; c < 3; c++)
+                if (abs(a[i + c] - b[i + c]) > sr.tolerance) { bad++; break; }
+    }
+    UnloadImage(golden);
+
+    sr.compared++;
+    if (bad > 0)
+    {
+        sr.failed++;
+        const char *actual = TextFormat("%s/frame_%05d.actual.png", sr.goldenDir, sr.frame);
+        TraceLog(LOG_WARNING, "HEADLESS: frame %d differs from golden in %d pixels, wrote %s", sr.frame, bad, actual);
+        ExportImage((Image){ sr.pixels, sr.w, sr.h, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 }, actual);
+    }
+}
+
+// highest frame number with a golden in dir, -1 if there are none
+static int SrLastGolden(const char *dir)
+{
+    int last = -1;
+    DIR *d = opendir(dir);
+    if (!d) return last;
+    for (struct dirent *f; (f = readdir(d)); )
+    {
+        int n, end = 0;
+        if (sscanf(f->d_name, "frame_%d.png%n", &n, &end) == 1 && end > 0 && f->d_name[end] == '\0' && n > last) last = n;
+    }
+    closedir(d);
+    return last;
+}
+
+// rasterizes everything recorded since the last flush; EndDrawing calls it, and so can
+// anyone who needs the frame so far (frame capture, the governor's render sample).
+// draws pushed after a flush land on top at the next one, same as a GL batch flush
+static void SrFlush(void)
+{
+    if (sr.rastered == sr.cmdCount) return;
+    double start = SrNow();
+    pthread_mutex_lock(&sr.lock);
+    atomic_store(&sr.nextTile, 0);
+    sr.busy = sr.threadCount;
+    sr.generation++;
+    pthread_cond_broadcast(&sr.start);
+    pthread_mutex_unlock(&sr.lock);
+
+    SrRunTiles();
+
+    pthread_mutex_lock(&sr.lock);
+    while (sr.busy > 0) pthread_cond_wait(&sr.done, &sr.lock);
+    pthread_mutex_unlock(&sr.lock);
+    sr.rasterTime += SrNow() - start;
+    sr.rastered = sr.cmdCount;
+}
+
+static void SrEndDrawing(void)
+{
+    SrFlush();
+    if (sr.recordDir)
+        ExportImage((Image){ sr.pixels, sr.w, sr.h, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 },
+                    TextFormat("%s/frame_%05d.png", sr.recordDir, sr.frame));
+    if (sr.goldenDir) SrDiffGolden();
+    sr.frame++;
+}
+
+// exits non zero when any golden mismatched, or when a golden run checked nothing (missing
+// or empty golden dir) or stopped before its last golden, so CI can just check the status
+static void SrClose(void)
+{
+    pthread_mutex_lock(&sr.lock);
+    sr.quit = true;
+    pthread_cond_broadcast(&sr.start);
+    pthread_mutex_unlock(&sr.lock);
+    for (int i = 0; i < sr.threadCount; i++) pthread_join(sr.threads[i], NULL);
+
+    TraceLog(LOG_INFO, "HEADLESS: %d frames, %.3f ms raster avg, %d compared, %d failed",
+             sr.frame, sr.frame ? sr.rasterTime * 1000.0 / sr.frame : 0.0, sr.compared, sr.failed);
+    if (sr.goldenDir)
+    {
+        int last = SrLastGolden(sr.goldenDir);
+        if (sr.compared == 0)
+        {
+            TraceLog(LOG_ERROR, "HEADLESS: no goldens compared, is %s there?", sr.goldenDir);
+            sr.failed++;
+        }
+        if (last >= sr.frame)
+        {
+            TraceLog(LOG_ERROR, "HEADLESS: golden frame %d never rendered, run stopped at %d", last, sr.frame);
+            sr.failed++;
+        }
+    }
+    if (sr.replay) fclose(sr.replay);
+    free(sr.cmds);
+    free(sr.pixels);
+    if (sr.failed > 0) exit(1);
+}
+
+#define InitWindow(width, height, title)    SrInit(width, height, title)
+#define CloseWindow()                       SrClose()
+#define WindowShouldClose()                 SrWindowShouldClose()
+#define GetScreenWidth()                    (sr.w)
+#define GetScreenHeight()                   (sr.h)
+#define SetTargetFPS(fps)                   ((void)(fps))
+#define GetFrameTime()                      (1.0f/60.0f)
+#define GetTime()                           SrNow()
+#define IsKeyDown(key)                      SrIsKeyDown(key)
+#define IsKeyPressed(key)                   SrIsKeyPressed(key)
+#define BeginDrawing()                      SrBeginDrawing()
+#define EndDrawing()                        SrEndDrawing()
+#define rlDrawRenderBatchActive()           SrFlush()
+#define ClearBackground                     SrClearBackground
+#define DrawPixel                           SrDrawPixel
+#define DrawPixelV                          SrDrawPixelV
+#define DrawCircle                          SrDrawCircle
+#define DrawCircleV                         SrDrawCircleV
+#define DrawRing                            SrDrawRing
+#define DrawRectangle                       SrDrawRectangle
+#define DrawPoly                            SrDrawPoly
+#define DrawText                            SrDrawText
+
+#endif
\ No newline at end of file